@@ -32,12 +32,15 @@ WavingAudioProcessorEditor::WavingAudioProcessorEditor(WavingAudioProcessor& p)
     addAndMakeVisible(sampleDataText);
     sampleDataText.setText("POINTED DATA", juce::NotificationType::dontSendNotification);
 
-    formatManager.registerBasicFormats();
-    
+    audioProcessor.addChangeListener(this);
+    // Show whatever was restored from the session and fetch the waveform
+    audioProcessor.restoreSourceAsync();
+    refreshFromProcessor();
 }
 
 WavingAudioProcessorEditor::~WavingAudioProcessorEditor()
 {
+    audioProcessor.removeChangeListener(this);
 }
 
 //==============================================================================
@@ -54,7 +57,7 @@ void WavingAudioProcessorEditor::paint(juce::Graphics& g)
     g.drawRect(waveBox);
     if (shouldPaintWaveform) {
         waveformPath.clear();
-        std::vector<float> waveform_vec = audioProcessor.waveVector;
+        std::vector<float> waveform_vec = audioProcessor.getWaveVector();
         int ratio = (int) waveform_vec.size() / getWidth();
         waveformPoints.clear();
         // scale audio file to window size. x axis
@@ -145,22 +148,12 @@ void WavingAudioProcessorEditor::buttonClicked(juce::Button *button) {
 
             if (file != juce::File{})
             {
-                auto* reader =  formatManager.createReaderFor (file);
-
-                if (reader != nullptr)
+                if (audioProcessor.loadFile (file))
                 {
-
-                    //audioProcessor.transportSource.setSource (newSource.get(), 0, nullptr, reader->sampleRate);
-                    //playButton.setEnabled (true);
-                    //audioProcessor.readerSource.reset (newSource.release());
-                    juce::AudioFormatReaderSource newSource(reader, true);
-                    audioProcessor.initWaveVector(newSource);
-
                     shouldPaintWaveform = true;
                     shouldPaintSpectrum = true;
                     repaint();
                     printWaveData ();
-                    
                 }
             }
         });
@@ -169,6 +162,42 @@ void WavingAudioProcessorEditor::buttonClicked(juce::Button *button) {
     }
 }
 
+void WavingAudioProcessorEditor::changeListenerCallback(juce::ChangeBroadcaster*) {
+    // State was restored or the background restore finished. A missing
+    // source is only retried when the editor is reopened.
+    if (! audioProcessor.isSourceMissing()) {
+        audioProcessor.restoreSourceAsync();
+    }
+    refreshFromProcessor();
+}
+
+void WavingAudioProcessorEditor::refreshFromProcessor() {
+    if (audioProcessor.hasAnalysis()) {
+        shouldPaintSpectrum = true;
+        printWaveData();
+    } else {
+        spectrumPath.clear();
+        waveDataText.setText("WAVE DATA", juce::dontSendNotification);
+    }
+    if (audioProcessor.isSourceMissing()) {
+        waveDataText.setText(waveDataText.getText() + "\nSource file not found:\n"
+            + audioProcessor.getSourceFile().getFullPathName(), juce::dontSendNotification);
+    }
+    if (audioProcessor.getNumWaveSamples() > 0) {
+        shouldPaintWaveform = true;
+        if (audioProcessor.getPointerX() >= 0.f) {
+            lastMousePosition = { audioProcessor.getPointerX(), (float) WAVEFORM_CENTER_Y };
+            printSampleData(lastMousePosition.getX());
+            shouldPaintPointer = true;
+        } else {
+            sampleDataText.setText("POINTED DATA", juce::dontSendNotification);
+        }
+    } else {
+        waveformPath.clear();
+    }
+    repaint();
+}
+
 // Mouse handling..
 void WavingAudioProcessorEditor::mouseDown (const juce::MouseEvent& e)
 {
@@ -180,25 +209,30 @@ void WavingAudioProcessorEditor::paintSampleData (const juce::MouseEvent& e)
     lastMousePosition = e.position;
     //if click inside waveform rectangle, show amplitude
     if (e.position.y <= WAVEFORM_Y + WAVEFORM_H && e.position.y >= WAVEFORM_Y && e.position.x >= 0 && e.position.x < getWidth()) {
-        //amplitude = -2.f * ((e.position.y - WAVEFORM_Y) / (WAVEFORM_H) - 0.5f);
-        float y = std::get<1>(waveformCoordinates[(int) e.position.x]);
-        amplitude = -2.f * ((y  - WAVEFORM_Y) / (WAVEFORM_H) - 0.5f);
-        float db = 20 * log10(abs(amplitude));
-
-        WaveData wd = audioProcessor.getWaveData();
-        int index = (int) std::lround((e.position.x / ((float) getWidth())) * wd.length_samples);
-        float seconds = index / (float) audioProcessor.getSampleRate();
-        juce::String sampleDataString = "POINTED DATA\nAmplitude = " + std::to_string(amplitude)
-            + "\nAmplitude (dB FS) = " + std::to_string(db) + " dB FS"
-            + "\nSample index = " + std::to_string(index)
-            + "\nTime (seconds) = " + std::to_string(seconds) + " seconds";
-        sampleDataText.setText(sampleDataString, juce::NotificationType::dontSendNotification);
+        printSampleData(e.position.x);
+        audioProcessor.setPointerX(e.position.x);
         shouldPaintPointer = true;
     }
     repaint();
 
 }
 
+void WavingAudioProcessorEditor::printSampleData (float x) {
+    // Same decimated sample the waveform path draws at this x
+    int ratio = audioProcessor.getNumWaveSamples() / getWidth();
+    amplitude = audioProcessor.getWaveSample((int) x * ratio);
+    float db = 20 * log10(abs(amplitude));
+
+    WaveData wd = audioProcessor.getWaveData();
+    int index = (int) std::lround((x / ((float) getWidth())) * wd.length_samples);
+    float seconds = index / (float) audioProcessor.getSampleRate();
+    juce::String sampleDataString = "POINTED DATA\nAmplitude = " + std::to_string(amplitude)
+        + "\nAmplitude (dB FS) = " + std::to_string(db) + " dB FS"
+        + "\nSample index = " + std::to_string(index)
+        + "\nTime (seconds) = " + std::to_string(seconds) + " seconds";
+    sampleDataText.setText(sampleDataString, juce::NotificationType::dontSendNotification);
+}
+
 void WavingAudioProcessorEditor::mouseUp (const juce::MouseEvent& e)
 {
     paintSampleData(e);
@@ -15,7 +15,8 @@
 /**
 */
 class WavingAudioProcessorEditor final : public juce::AudioProcessorEditor,
-                                      public juce::Button::Listener
+                                      public juce::Button::Listener,
+                                      public juce::ChangeListener
 {
 public:
     explicit WavingAudioProcessorEditor (WavingAudioProcessor&);
@@ -31,9 +32,12 @@ public:
 
     // Controls
     void buttonClicked(juce::Button*) override;
+    void changeListenerCallback(juce::ChangeBroadcaster*) override;
 
     void printWaveData();
+    void printSampleData (float x);
     void paintSampleData (const juce::MouseEvent&);
+    void refreshFromProcessor();
 
 
 private:
@@ -42,7 +46,6 @@ private:
     WavingAudioProcessor& audioProcessor;
 
     std::unique_ptr<juce::FileChooser> fileChooser;
-    juce::AudioFormatManager formatManager;
 
     juce::TextButton openButton;
     juce::Label waveDataText;
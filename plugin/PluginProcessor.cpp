@@ -20,11 +20,27 @@ WavingAudioProcessor::WavingAudioProcessor()
                      #endif
                        )
 {
-
+    formatManager.registerBasicFormats();
 }
 
 WavingAudioProcessor::~WavingAudioProcessor()
 {
+    // Drops this instance's queued restores and interrupts a running one,
+    // which stops at its next read block. Jobs of other instances sharing
+    // the pool are not waited for.
+    struct OwnRestoreJobs final : public juce::ThreadPool::JobSelector
+    {
+        explicit OwnRestoreJobs (WavingAudioProcessor& p) : owner (p) {}
+        bool isJobSuitable (juce::ThreadPoolJob* job) override
+        {
+            auto* restore = dynamic_cast<RestoreJob*> (job);
+            return restore != nullptr && &restore->owner == &owner;
+        }
+        WavingAudioProcessor& owner;
+    };
+
+    OwnRestoreJobs ownJobs (*this);
+    analysisPool->removeAllJobs (true, -1, &ownJobs);
 }
 
 //==============================================================================
@@ -96,7 +112,9 @@ void WavingAudioProcessor::changeProgramName (int index, const juce::String& new
 void WavingAudioProcessor::prepareToPlay (double sampleRate, int samplesPerBlock)
 {
     juce::ignoreUnused (samplesPerBlock);
-    waveData = WaveData((float) sampleRate);
+    // Keep any analysis restored from the session state
+    const juce::ScopedLock sl (stateLock);
+    waveData.setSampleRate((float) sampleRate);
 }
 
 void WavingAudioProcessor::releaseResources()
@@ -156,17 +174,71 @@ juce::AudioProcessorEditor* WavingAudioProcessor::createEditor()
 //==============================================================================
 void WavingAudioProcessor::getStateInformation (juce::MemoryBlock& destData)
 {
-    juce::ignoreUnused (destData);
-    // You should use this method to store your parameters in the memory block.
-    // You could do that either as raw data, or use the XML or ValueTree classes
-    // as intermediaries to make it easy to save and load complex data.
+    // Only the file reference and the analysis results are stored, never the
+    // audio itself, so the state stays small.
+    juce::XmlElement state ("WavingState");
+
+    const juce::ScopedLock sl (stateLock);
+
+    auto* source = state.createNewChildElement ("Source");
+    source->setAttribute ("path", sourceFile.getFullPathName());
+    source->setAttribute ("size", juce::String (sourceSize));
+    source->setAttribute ("modTime", juce::String (sourceModTime));
+
+    auto* view = state.createNewChildElement ("View");
+    view->setAttribute ("pointerX", pointerX);
+
+    auto* fft = state.createNewChildElement ("Fft");
+    fft->setAttribute ("size", fftSize);
+
+    if (analysisValid)
+        state.addChildElement (waveData.createXml().release());
+
+    copyXmlToBinary (state, destData);
 }
 
 void WavingAudioProcessor::setStateInformation (const void* data, int sizeInBytes)
 {
-    juce::ignoreUnused (data, sizeInBytes);
-    // You should use this method to restore your parameters from this memory block,
-    // whose contents will have been created by the getStateInformation() call.
+    // The file isn't touched here; it's read back lazily by restoreSourceAsync()
+    // once an editor needs the waveform, so loading a session stays fast.
+    auto state = getXmlFromBinary (data, sizeInBytes);
+
+    if (state == nullptr || ! state->hasTagName ("WavingState"))
+        return;
+
+    {
+        const juce::ScopedLock sl (stateLock);
+
+        ++sourceGeneration;
+        waveVector.clear();
+        sourceFile = juce::File{};
+        sourceSize = 0;
+        sourceModTime = 0;
+        analysisValid = false;
+        sourceMissing = false;
+
+        if (auto* source = state->getChildByName ("Source"))
+        {
+            auto path = source->getStringAttribute ("path");
+            if (juce::File::isAbsolutePath (path))
+                sourceFile = juce::File (path);
+            sourceSize = source->getStringAttribute ("size").getLargeIntValue();
+            sourceModTime = source->getStringAttribute ("modTime").getLargeIntValue();
+        }
+
+        if (auto* view = state->getChildByName ("View"))
+            pointerX = (float) view->getDoubleAttribute ("pointerX", -1.0);
+
+        // Results computed with a different FFT size can't be reused
+        auto* fft = state->getChildByName ("Fft");
+        auto savedFftSize = fft != nullptr ? fft->getIntAttribute ("size") : 0;
+
+        if (auto* analysis = state->getChildByName ("Analysis"))
+            analysisValid = savedFftSize == fftSize && waveData.restoreFromXml (*analysis);
+
+        sourceRestorePending = sourceFile != juce::File{};
+    }
+    sendChangeMessage();
 }
 
 //==============================================================================
@@ -176,17 +248,173 @@ juce::AudioProcessor* JUCE_CALLTYPE createPluginFilter()
     return new WavingAudioProcessor();
 }
 
-void WavingAudioProcessor::initWaveVector(juce::AudioFormatReaderSource& readerSource) {
-    int size = (int) readerSource.getTotalLength();
-    waveData.length_samples = size;
-    juce::AudioBuffer<float> buffer(1, size);
-    juce::AudioSourceChannelInfo info(buffer);
-    readerSource.getNextAudioBlock(info);
+WaveData WavingAudioProcessor::getWaveData() const {
+    const juce::ScopedLock sl (stateLock);
+    return waveData;
+}
+
+std::vector<float> WavingAudioProcessor::getWaveVector() const {
+    const juce::ScopedLock sl (stateLock);
+    return waveVector;
+}
+
+int WavingAudioProcessor::getNumWaveSamples() const {
+    const juce::ScopedLock sl (stateLock);
+    return (int) waveVector.size();
+}
+
+float WavingAudioProcessor::getWaveSample(int index) const {
+    const juce::ScopedLock sl (stateLock);
+    return juce::isPositiveAndBelow(index, (int) waveVector.size()) ? waveVector[(size_t) index] : 0.f;
+}
 
-    const float *readPointer = buffer.getReadPointer(0);
-    waveVector.clear();
-    for (int i = 0; i < size; i++) {
-        waveVector.push_back(readPointer[i]);
+bool WavingAudioProcessor::hasAnalysis() const {
+    const juce::ScopedLock sl (stateLock);
+    return analysisValid;
+}
+
+bool WavingAudioProcessor::isSourceMissing() const {
+    const juce::ScopedLock sl (stateLock);
+    return sourceMissing;
+}
+
+juce::File WavingAudioProcessor::getSourceFile() const {
+    const juce::ScopedLock sl (stateLock);
+    return sourceFile;
+}
+
+float WavingAudioProcessor::getPointerX() const {
+    const juce::ScopedLock sl (stateLock);
+    return pointerX;
+}
+
+void WavingAudioProcessor::setPointerX(float x) {
+    const juce::ScopedLock sl (stateLock);
+    pointerX = x;
+}
+
+bool WavingAudioProcessor::loadFile(const juce::File& file) {
+    auto size = file.getSize();
+    auto modTime = file.getLastModificationTime().toMilliseconds();
+
+    std::vector<float> samples;
+    if (! readSourceFile(file, samples)) {
+        return false;
+    }
+    auto analysis = getWaveData();
+    analyseSamples(samples, analysis);
+
+    const juce::ScopedLock sl (stateLock);
+    // Drop the results of any restore still in flight
+    ++sourceGeneration;
+    sourceRestorePending = false;
+    sourceMissing = false;
+
+    waveVector = std::move(samples);
+    publishAnalysis(analysis);
+    sourceFile = file;
+    sourceSize = size;
+    sourceModTime = modTime;
+    pointerX = -1.f;
+    analysisValid = true;
+    return true;
+}
+
+void WavingAudioProcessor::restoreSourceAsync() {
+    {
+        const juce::ScopedLock sl (stateLock);
+        if (! sourceRestorePending) {
+            return;
+        }
+        sourceRestorePending = false;
+        sourceMissing = false;
+    }
+    analysisPool->addJob(new RestoreJob(*this), true);
+}
+
+void WavingAudioProcessor::runRestore(juce::ThreadPoolJob& job) {
+    juce::File file;
+    juce::int64 savedSize, savedModTime;
+    bool cached;
+    WaveData analysis;
+    int generation;
+    {
+        const juce::ScopedLock sl (stateLock);
+        file = sourceFile;
+        savedSize = sourceSize;
+        savedModTime = sourceModTime;
+        cached = analysisValid;
+        analysis = waveData;
+        generation = sourceGeneration;
+    }
+
+    // Fingerprint before reading, so a change during the read is caught next time
+    auto size = file.getSize();
+    auto modTime = file.getLastModificationTime().toMilliseconds();
+    auto unchanged = cached && size == savedSize && modTime == savedModTime;
+
+    std::vector<float> samples;
+    auto loaded = readSourceFile(file, samples, &job);
+    if (job.shouldExit()) {
+        return;
+    }
+    if (loaded && ! unchanged) {
+        analyseSamples(samples, analysis);
+    }
+
+    {
+        const juce::ScopedLock sl (stateLock);
+        // A newer state or file superseded this restore
+        if (generation != sourceGeneration) {
+            return;
+        }
+        if (loaded) {
+            waveVector = std::move(samples);
+            publishAnalysis(analysis);
+            sourceSize = size;
+            sourceModTime = modTime;
+            analysisValid = true;
+        } else {
+            // Keep it pending so reopening the editor tries again
+            sourceMissing = true;
+            sourceRestorePending = true;
+        }
     }
-    waveData.calculateWaveData(buffer);
+    sendChangeMessage();
+}
+
+// Called with stateLock held. The analysis was copied before the unlocked
+// work, so the host may have changed the sample rate since then.
+void WavingAudioProcessor::publishAnalysis(const WaveData& analysis) {
+    auto currentSampleRate = waveData.getSampleRate();
+    waveData = analysis;
+    waveData.setSampleRate(currentSampleRate);
+}
+
+bool WavingAudioProcessor::readSourceFile(const juce::File& file, std::vector<float>& samples, juce::ThreadPoolJob* job) {
+    std::unique_ptr<juce::AudioFormatReader> reader (formatManager.createReaderFor (file));
+    if (reader == nullptr || reader->lengthInSamples <= 0) {
+        return false;
+    }
+    // Read straight into the vector so long files aren't held twice, in
+    // blocks so a restore job can be interrupted part way through
+    const int blockSize = 1 << 16;
+    auto total = reader->lengthInSamples;
+    samples.resize((size_t) total);
+    for (juce::int64 start = 0; start < total; start += blockSize) {
+        if (job != nullptr && job->shouldExit()) {
+            return false;
+        }
+        int numSamples = (int) juce::jmin((juce::int64) blockSize, total - start);
+        float* channels[] = { samples.data() + start };
+        juce::AudioBuffer<float> block(channels, 1, numSamples);
+        reader->read(&block, 0, numSamples, start, true, false);
+    }
+    return true;
+}
+
+void WavingAudioProcessor::analyseSamples(std::vector<float>& samples, WaveData& analysis) {
+    float* channels[] = { samples.data() };
+    juce::AudioBuffer<float> buffer(channels, 1, (int) samples.size());
+    analysis.calculateWaveData(buffer);
 }
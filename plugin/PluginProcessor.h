@@ -19,7 +19,8 @@
 //==============================================================================
 /**
 */
-class WavingAudioProcessor final : public juce::AudioProcessor
+class WavingAudioProcessor final : public juce::AudioProcessor,
+                                   public juce::ChangeBroadcaster
 {
 public:
     //==============================================================================
@@ -59,14 +60,68 @@ public:
     void setStateInformation (const void* data, int sizeInBytes) override;
 
 
-    WaveData getWaveData() { return waveData; };
-    void initWaveVector(juce::AudioFormatReaderSource& readerSource);
+    WaveData getWaveData() const;
+    std::vector<float> getWaveVector() const;
+    int getNumWaveSamples() const;
+    float getWaveSample(int index) const;
 
-    std::vector<float> waveVector;
+    // Opens and analyses a file chosen by the user.
+    bool loadFile(const juce::File& file);
+    // Reads back the file referenced by a restored state on the shared
+    // analysis pool. Only re-analyses it if it changed since the state
+    // was saved.
+    void restoreSourceAsync();
+    bool hasAnalysis() const;
+    // True when the restored source file couldn't be read
+    bool isSourceMissing() const;
+    juce::File getSourceFile() const;
+
+    float getPointerX() const;
+    void setPointerX(float x);
 
 private:
     //==============================================================================
     JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (WavingAudioProcessor)
 
+    // One worker thread shared by every plugin instance
+    struct AnalysisPool final : public juce::ThreadPool
+    {
+        AnalysisPool() : juce::ThreadPool (1) {}
+    };
+
+    // Every restore is its own job, so one requested while another is
+    // running just queues behind it.
+    class RestoreJob final : public juce::ThreadPoolJob
+    {
+    public:
+        explicit RestoreJob (WavingAudioProcessor& p) : juce::ThreadPoolJob ("Waving restore"), owner (p) {}
+        JobStatus runJob() override { owner.runRestore (*this); return jobHasFinished; }
+
+        WavingAudioProcessor& owner;
+    };
+
+    void runRestore(juce::ThreadPoolJob& job);
+    void publishAnalysis(const WaveData& analysis);
+    bool readSourceFile(const juce::File& file, std::vector<float>& samples, juce::ThreadPoolJob* job = nullptr);
+    static void analyseSamples(std::vector<float>& samples, WaveData& analysis);
+
+    // Guards the session state below. Hosts may call the state methods from
+    // any thread, while the editor reads it on the message thread.
+    juce::CriticalSection stateLock;
     WaveData waveData;
+    std::vector<float> waveVector;
+
+    // Source file and the fingerprint it had when it was last analysed
+    juce::File sourceFile;
+    juce::int64 sourceSize { 0 };
+    juce::int64 sourceModTime { 0 };
+    int fftSize { FFT_SIZE };
+    float pointerX { -1.f };
+    bool analysisValid { false };
+    bool sourceMissing { false };
+    bool sourceRestorePending { false };
+    int sourceGeneration { 0 };
+
+    juce::AudioFormatManager formatManager;
+    juce::SharedResourcePointer<AnalysisPool> analysisPool;
 };
@@ -1,4 +1,5 @@
 #include "WaveData.h"
+#include <mutex>
 
 WaveData::WaveData() {
 }
@@ -7,6 +8,17 @@ WaveData::WaveData(float newSampleRate) {
     sampleRate = newSampleRate;
 }
 
+void WaveData::setSampleRate(float newSampleRate) {
+    sampleRate = newSampleRate;
+    updateTimes();
+}
+
+// Keeps the time fields in step with the current sample rate
+void WaveData::updateTimes() {
+    length_seconds = length_samples / sampleRate;
+    peak_time = peak_idx / sampleRate;
+}
+
 
 void WaveData::calculateWaveData(juce::AudioBuffer<float>& buffer) {
     length_samples = buffer.getNumSamples();
@@ -59,7 +71,46 @@ void WaveData::calculateWaveData(juce::AudioBuffer<float>& buffer) {
 }
 
 void WaveData::computeFft(int fft_size, float* input, fftwf_complex* output) {
-    fftwf_plan p = fftwf_plan_dft_r2c_1d(fft_size, input, output, FFTW_ESTIMATE);
+    // Only fftwf_execute is thread-safe. Every plugin instance shares the
+    // planner, so creating and destroying plans has to be serialized.
+    static std::mutex plannerMutex;
+    fftwf_plan p;
+    {
+        const std::lock_guard<std::mutex> lock(plannerMutex);
+        p = fftwf_plan_dft_r2c_1d(fft_size, input, output, FFTW_ESTIMATE);
+    }
     fftwf_execute(p); /* repeat as needed */
+    const std::lock_guard<std::mutex> lock(plannerMutex);
     fftwf_destroy_plan(p);
 }
+
+
+std::unique_ptr<juce::XmlElement> WaveData::createXml() const {
+    auto xml = std::make_unique<juce::XmlElement>("Analysis");
+    xml->setAttribute("lengthSamples", length_samples);
+    xml->setAttribute("rmsFrac", rms_frac);
+    xml->setAttribute("rmsDb", rms_db);
+    xml->setAttribute("peakFrac", peak_frac);
+    xml->setAttribute("peakDb", peak_db);
+    xml->setAttribute("peakIdx", peak_idx);
+    xml->setAttribute("spectrum", juce::MemoryBlock(spectrum, sizeof(spectrum)).toBase64Encoding());
+    return xml;
+}
+
+bool WaveData::restoreFromXml(const juce::XmlElement& xml) {
+    juce::MemoryBlock spectrumData;
+    if (! xml.hasTagName("Analysis")
+        || ! spectrumData.fromBase64Encoding(xml.getStringAttribute("spectrum"))
+        || spectrumData.getSize() != sizeof(spectrum)) {
+        return false;
+    }
+    length_samples = xml.getIntAttribute("lengthSamples");
+    rms_frac = (float) xml.getDoubleAttribute("rmsFrac");
+    rms_db = (float) xml.getDoubleAttribute("rmsDb");
+    peak_frac = (float) xml.getDoubleAttribute("peakFrac");
+    peak_db = (float) xml.getDoubleAttribute("peakDb");
+    peak_idx = xml.getIntAttribute("peakIdx");
+    spectrumData.copyTo(spectrum, 0, sizeof(spectrum));
+    updateTimes();
+    return true;
+}
@@ -10,21 +10,32 @@ class WaveData
     public:
     WaveData();
     WaveData(float newSampleRate);
+    void setSampleRate(float newSampleRate);
+    float getSampleRate() const { return sampleRate; }
     void calculateWaveData(juce::AudioBuffer<float>& buffer);
     void computeFft(int fft_size, float* input, fftwf_complex* output);
 
-    int length_samples;
+    // Cached analysis results, stored in the plugin state so a reopened
+    // session doesn't need to re-analyse the file. The sample rate is host
+    // configuration set by prepareToPlay, so it is not part of it; the time
+    // fields are derived from it instead of being stored.
+    std::unique_ptr<juce::XmlElement> createXml() const;
+    bool restoreFromXml(const juce::XmlElement& xml);
+
+    int length_samples { 0 };
     float length_seconds;
     float rms_frac;
     float rms_db;
     float peak_frac;
     float peak_db;
-    int peak_idx;
+    int peak_idx { 0 };
     float peak_time;
     float spectrum[HALF_FFT_SIZE];
 
     private:
-    float sampleRate;
+    float sampleRate { 44100.f };
+
+    void updateTimes();
 
 
 };
\ No newline at end of file